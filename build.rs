@@ -1,3 +1,10 @@
+const SHARED: &[&str] = &[
+    "src/native/file.c",
+    "src/native/mixer.c",
+    "src/native/stream.c",
+    "src/native/timer.c",
+];
+
 fn main() {
     let target = std::env::var("TARGET").unwrap();
     if target.contains("darwin") {
@@ -10,6 +17,7 @@ fn main() {
             .flag("-Wno-unused-parameter")
             .flag("-mmacosx-version-min=10.10")
             .file("src/native/macos.m")
+            .files(SHARED)
             .compile("native.a");
     } else if target.contains("x86_64-apple-ios") {
         cc::Build::new()
@@ -21,6 +29,7 @@ fn main() {
             .flag("-Wno-unused-parameter")
             .flag("-mios-simulator-version-min=13.0")
             .file("src/native/ios.m")
+            .files(SHARED)
             .compile("native.a");
     } else if target.contains("aarch64-apple-ios") {
         cc::Build::new()
@@ -31,11 +40,13 @@ fn main() {
             .flag("-pedantic")
             .flag("-Wno-unused-parameter")
             .file("src/native/ios.m")
+            .files(SHARED)
             .compile("native.a");
     } else if target.contains("windows") {
         cc::Build::new()
             .flag("-Wall")
             .file("src/native/win32.c")
+            .files(SHARED)
             .compile("native.a");
         println!("cargo:rustc-link-lib=user32");
         println!("cargo:rustc-link-lib=d3d11");
@@ -48,6 +59,7 @@ fn main() {
             .flag("-Wall")
             .flag("-Werror")
             .file("src/native/android.c")
+            .files(SHARED)
             .compile("native.a");
     } else if target.contains("linux") {
         cc::Build::new()
@@ -58,10 +70,13 @@ fn main() {
             .flag("-Wno-unused-parameter")
             .flag("-Wno-unused-but-set-variable")
             .file("src/native/x11.c")
+            .file("src/native/alsa.c")
+            .files(SHARED)
             .compile("native.a");
         println!("cargo:rustc-link-lib=X11");
         println!("cargo:rustc-link-lib=EGL");
         println!("cargo:rustc-link-lib=GL");
         println!("cargo:rustc-link-lib=asound");
+        println!("cargo:rustc-link-lib=pthread");
     }
 }
@@ -0,0 +1,162 @@
+#include "alsa.h"
+
+#include <sched.h>
+
+static void audioRecover(audio *a, int err)
+{
+  if (err == -EPIPE) __atomic_add_fetch(&a->underruns, 1, __ATOMIC_RELAXED);
+  snd_pcm_recover(a->pcm, err, 1);
+}
+
+static void audioFill(audio *a, int16_t *out, snd_pcm_uframes_t frames)
+{
+  if (a->callback)
+    a->callback(a->user, out, frames);
+  else
+    memset(out, 0, frames * 2 * sizeof(int16_t));
+}
+
+static int audioWrite(audio *a, snd_pcm_uframes_t frames)
+{
+  // Render straight into the ring buffer when the device allows it
+  while (a->mmap && frames > 0)
+  {
+    const snd_pcm_channel_area_t *areas;
+    snd_pcm_uframes_t offset, size = frames;
+    int err = snd_pcm_mmap_begin(a->pcm, &areas, &offset, &size);
+    if (err < 0) return err;
+
+    char *base = (char *)areas[0].addr + areas[0].first / 8;
+    audioFill(a, (int16_t *)(base + offset * areas[0].step / 8), size);
+
+    snd_pcm_sframes_t written = snd_pcm_mmap_commit(a->pcm, offset, size);
+    if (written < 0) return written;
+    if ((snd_pcm_uframes_t)written != size) return -EPIPE;
+    frames -= size;
+  }
+
+  // Otherwise copy one period at a time
+  while (!a->mmap && frames >= a->period)
+  {
+    audioFill(a, a->scratch, a->period);
+    snd_pcm_sframes_t written = snd_pcm_writei(a->pcm, a->scratch, a->period);
+    if (written < 0) return written;
+    frames -= written;
+  }
+  return 0;
+}
+
+static void *audioThread(void *data)
+{
+  audio *a = data;
+
+  // Ask for real-time scheduling, this fails without CAP_SYS_NICE/rtprio
+  struct sched_param param = {.sched_priority = sched_get_priority_min(
+                                                   SCHED_FIFO) + 10};
+  pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+  while (__atomic_load_n(&a->running, __ATOMIC_ACQUIRE))
+  {
+    snd_pcm_sframes_t avail = snd_pcm_avail_update(a->pcm);
+    if (avail < 0)
+    {
+      audioRecover(a, avail);
+      continue;
+    }
+
+    // Sleep until a full period can be written
+    if ((snd_pcm_uframes_t)avail < a->period)
+    {
+      if (snd_pcm_state(a->pcm) == SND_PCM_STATE_PREPARED)
+        snd_pcm_start(a->pcm);
+      int err = snd_pcm_wait(a->pcm, 100);
+      if (err < 0) audioRecover(a, err);
+      continue;
+    }
+
+    int err = audioWrite(a, avail - avail % a->period);
+    if (err < 0) audioRecover(a, err);
+    if (snd_pcm_state(a->pcm) == SND_PCM_STATE_PREPARED) snd_pcm_start(a->pcm);
+
+    snd_pcm_sframes_t delay;
+    if (snd_pcm_delay(a->pcm, &delay) == 0)
+      __atomic_store_n(&a->latency, delay, __ATOMIC_RELAXED);
+  }
+  return NULL;
+}
+
+int audioOpen(audio *a, const char *device, unsigned int rate,
+              snd_pcm_uframes_t period, unsigned int periods,
+              audioCallback callback, void *user)
+{
+  memset(a, 0, sizeof(audio));
+  a->callback = callback;
+  a->user = user;
+  int err = snd_pcm_open(&a->pcm, device, SND_PCM_STREAM_PLAYBACK, 0);
+  if (err < 0) return err;
+
+  // Set Hardware Parameters, falling back to copies without mmap support
+  int dir = 0;
+  snd_pcm_uframes_t buffer = period * periods;
+  snd_pcm_hw_params_t *hw_params;
+  snd_pcm_hw_params_alloca(&hw_params);
+  snd_pcm_hw_params_any(a->pcm, hw_params);
+  a->mmap = snd_pcm_hw_params_set_access(a->pcm, hw_params,
+                                         SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0;
+  if (!a->mmap)
+    snd_pcm_hw_params_set_access(a->pcm, hw_params,
+                                 SND_PCM_ACCESS_RW_INTERLEAVED);
+  snd_pcm_hw_params_set_format(a->pcm, hw_params, SND_PCM_FORMAT_S16_LE);
+  snd_pcm_hw_params_set_channels(a->pcm, hw_params, 2);
+  snd_pcm_hw_params_set_rate_near(a->pcm, hw_params, &rate, &dir);
+  snd_pcm_hw_params_set_period_size_near(a->pcm, hw_params, &period, &dir);
+  snd_pcm_hw_params_set_buffer_size_near(a->pcm, hw_params, &buffer);
+  if ((err = snd_pcm_hw_params(a->pcm, hw_params)) < 0)
+  {
+    snd_pcm_close(a->pcm);
+    return err;
+  }
+  snd_pcm_hw_params_get_period_size(hw_params, &a->period, &dir);
+  snd_pcm_hw_params_get_buffer_size(hw_params, &a->buffer);
+  a->rate = rate;
+
+  // Set Software Parameters, starting explicitly once the buffer is filled
+  snd_pcm_sw_params_t *sw_params;
+  snd_pcm_sw_params_alloca(&sw_params);
+  snd_pcm_sw_params_current(a->pcm, sw_params);
+  snd_pcm_sw_params_set_avail_min(a->pcm, sw_params, a->period);
+  snd_pcm_sw_params_set_start_threshold(a->pcm, sw_params, a->buffer);
+  snd_pcm_sw_params(a->pcm, sw_params);
+
+  if (!a->mmap) a->scratch = malloc(a->period * 2 * sizeof(int16_t));
+
+  // Start the Audio Thread
+  a->running = 1;
+  if ((err = pthread_create(&a->thread, NULL, audioThread, a)) != 0)
+  {
+    free(a->scratch);
+    snd_pcm_close(a->pcm);
+    return -err;
+  }
+  return 0;
+}
+
+void audioClose(audio *a)
+{
+  if (!a->running) return;
+  __atomic_store_n(&a->running, 0, __ATOMIC_RELEASE);
+  pthread_join(a->thread, NULL);
+  snd_pcm_drop(a->pcm);
+  snd_pcm_close(a->pcm);
+  free(a->scratch);
+}
+
+long audioLatency(audio *a)
+{
+  return __atomic_load_n(&a->latency, __ATOMIC_RELAXED);
+}
+
+unsigned long audioUnderruns(audio *a)
+{
+  return __atomic_load_n(&a->underruns, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <alsa/asoundlib.h>
+#include <pthread.h>
+#include <stdint.h>
+
+// Fills `frames` interleaved stereo S16 frames. Runs on the audio thread.
+typedef void (*audioCallback)(void *user, int16_t *out, unsigned int frames);
+
+typedef struct
+{
+  snd_pcm_t *pcm;
+  pthread_t thread;
+  int running, mmap;
+  unsigned int rate;
+  snd_pcm_uframes_t period, buffer;
+  audioCallback callback;
+  void *user;
+  int16_t *scratch;
+  long latency;
+  unsigned long underruns;
+} audio;
+
+int audioOpen(audio *a, const char *device, unsigned int rate,
+              snd_pcm_uframes_t period, unsigned int periods,
+              audioCallback callback, void *user);
+void audioClose(audio *a);
+long audioLatency(audio *a);
+unsigned long audioUnderruns(audio *a);
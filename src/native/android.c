@@ -4,6 +4,9 @@
 #include <android_native_app_glue.h>
 #include <stdint.h>
 
+#include "mixer.h"
+#include "timer.h"
+
 EGLDisplay display;
 EGLSurface surface;
 SLEngineItf audioInterface;
@@ -11,6 +14,16 @@ SLObjectItf audioOutput;
 unsigned int gbuffer;
 int32_t prevId;
 float prevX, prevY, touchPosX, touchPosY, moveDeltaX, moveDeltaY;
+mixer voices;
+int16_t audioBuffers[2][MIXER_FRAMES * 2];
+int audioBuffer;
+
+static void audioCallback(SLAndroidSimpleBufferQueueItf queue, void *context)
+{
+  audioBuffer = !audioBuffer;
+  mixerRender(context, audioBuffers[audioBuffer], MIXER_FRAMES);
+  (*queue)->Enqueue(queue, audioBuffers[audioBuffer], sizeof(audioBuffers[0]));
+}
 
 static void engine_handle_cmd(struct android_app *app, int32_t cmd)
 {
@@ -88,6 +101,36 @@ static void engine_handle_cmd(struct android_app *app, int32_t cmd)
     (*engine)->GetInterface(engine, SL_IID_ENGINE, &audioInterface);
     (*audioInterface)->CreateOutputMix(audioInterface, &audioOutput, 1, 0, req);
     (*audioOutput)->Realize(audioOutput, 0);
+
+    // Create an Audio Player fed by the Mixer
+    SLDataLocator_AndroidSimpleBufferQueue bufferQueue = {
+        SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE, 2};
+    SLDataFormat_PCM pcm = {SL_DATAFORMAT_PCM,
+                            2,
+                            SL_SAMPLINGRATE_44_1,
+                            SL_PCMSAMPLEFORMAT_FIXED_16,
+                            SL_PCMSAMPLEFORMAT_FIXED_16,
+                            SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT,
+                            SL_BYTEORDER_LITTLEENDIAN};
+    SLDataSource source = {&bufferQueue, &pcm};
+    SLDataLocator_OutputMix outputMix = {SL_DATALOCATOR_OUTPUTMIX,
+                                         audioOutput};
+    SLDataSink sink = {&outputMix, NULL};
+    const SLInterfaceID ids[1] = {SL_IID_ANDROIDSIMPLEBUFFERQUEUE};
+    const SLboolean reqs[1] = {SL_BOOLEAN_TRUE};
+    SLObjectItf player;
+    SLPlayItf play;
+    SLAndroidSimpleBufferQueueItf queue;
+    mixerInit(&voices);
+    (*audioInterface)
+        ->CreateAudioPlayer(audioInterface, &player, &source, &sink, 1, ids,
+                            reqs);
+    (*player)->Realize(player, 0);
+    (*player)->GetInterface(player, SL_IID_PLAY, &play);
+    (*player)->GetInterface(player, SL_IID_ANDROIDSIMPLEBUFFERQUEUE, &queue);
+    (*queue)->RegisterCallback(queue, audioCallback, &voices);
+    (*play)->SetPlayState(play, SL_PLAYSTATE_PLAYING);
+    audioCallback(queue, &voices);
   }
 }
 
@@ -129,11 +172,9 @@ void android_main(struct android_app *app)
   app->onAppCmd = engine_handle_cmd;
   app->onInputEvent = engine_handle_input;
 
-  // Start the Timer
-  struct timespec time;
-  clock_gettime(CLOCK_MONOTONIC, &time);
-  uint64_t timerCurrent = (time.tv_sec * 10E8 + time.tv_nsec);
-  uint64_t lag = 0.0;
+  // Start the Timer, frames are paced by eglSwapBuffers
+  timer loop;
+  timerInit(&loop, 1E9 / 60, 0, 8);
 
   // Reset Deltas
   touchPosX = 0.0f;
@@ -151,16 +192,17 @@ void android_main(struct android_app *app)
     }
 
     // Update Timer
-    clock_gettime(CLOCK_MONOTONIC, &time);
-    uint64_t timerNext = (time.tv_sec * 10E8 + time.tv_nsec);
-    uint64_t timerDelta = timerNext - timerCurrent;
-    timerCurrent = timerNext;
+    timerUpdate(&loop);
 
     // Fixed updates
-    for (lag += timerDelta; lag >= 1.0 / 60.0; lag -= 1.0 / 60.0)
+    while (timerStep(&loop))
     {
     }
 
+    // Interpolation factor between the last two fixed updates
+    float alpha = timerAlpha(&loop);
+    (void)alpha;
+
     // Reset Deltas
     touchPosX = 0.0f;
     touchPosY = 0.0f;
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+// Minimal atomics for the lock-free queues, MSVC has no <stdatomic.h> in C
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#include <windows.h>
+
+static inline uint32_t atomicLoad(volatile uint32_t *p)
+{
+  uint32_t value = *p;
+  _ReadWriteBarrier();
+  return value;
+}
+
+static inline void atomicStore(volatile uint32_t *p, uint32_t value)
+{
+  _ReadWriteBarrier();
+  *p = value;
+}
+
+static inline uint32_t atomicAdd(volatile uint32_t *p, uint32_t value)
+{
+  return _InterlockedExchangeAdd((volatile long *)p, value) + value;
+}
+
+static inline int atomicCas(volatile uint32_t *p, uint32_t expected,
+                            uint32_t desired)
+{
+  return (uint32_t)_InterlockedCompareExchange((volatile long *)p, desired,
+                                               expected) == expected;
+}
+
+static inline void atomicFence() { MemoryBarrier(); }
+#else
+static inline uint32_t atomicLoad(volatile uint32_t *p)
+{
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomicStore(volatile uint32_t *p, uint32_t value)
+{
+  __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t atomicAdd(volatile uint32_t *p, uint32_t value)
+{
+  return __atomic_add_fetch(p, value, __ATOMIC_SEQ_CST);
+}
+
+static inline int atomicCas(volatile uint32_t *p, uint32_t expected,
+                            uint32_t desired)
+{
+  return __atomic_compare_exchange_n(p, &expected, desired, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomicFence() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+#endif
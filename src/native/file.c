@@ -0,0 +1,54 @@
+#include "file.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+int fileMap(mapping *m, const char *path)
+{
+  m->data = NULL;
+  m->size = 0;
+  m->handle = NULL;
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE) return -1;
+  LARGE_INTEGER size;
+  GetFileSizeEx(file, &size);
+  m->handle = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (!m->handle) return -1;
+  m->data = MapViewOfFile(m->handle, FILE_MAP_READ, 0, 0, 0);
+  m->size = (size_t)size.QuadPart;
+  if (!m->data) CloseHandle(m->handle);
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return -1;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0)
+  {
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    m->data = data == MAP_FAILED ? NULL : data;
+    m->size = st.st_size;
+  }
+  close(fd);
+#endif
+  return m->data ? 0 : -1;
+}
+
+void fileUnmap(mapping *m)
+{
+  if (!m->data) return;
+#if defined(_WIN32)
+  UnmapViewOfFile(m->data);
+  CloseHandle(m->handle);
+#else
+  munmap((void *)m->data, m->size);
+#endif
+  m->data = NULL;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Read-only memory mapping of a whole file
+typedef struct
+{
+  const uint8_t *data;
+  size_t size;
+  void *handle;
+} mapping;
+
+int fileMap(mapping *m, const char *path);
+void fileUnmap(mapping *m);
@@ -4,6 +4,9 @@
 @import QuartzCore;
 @import AudioToolbox;
 
+#include "mixer.h"
+#include "timer.h"
+
 NSString *postShader =
     @"#include <metal_stdlib>\n"
      "using namespace metal;"
@@ -35,37 +38,13 @@ NSString *quadShader =
      "    return half4(0, 0, 0, 1);"
      "}";
 
-typedef struct
-{
-  short *data;
-  int state;
-  size_t position;
-  size_t length;
-} voice;
-
 static OSStatus audioCallback(void *inRefCon,
                               AudioUnitRenderActionFlags *ioActionFlags,
                               const AudioTimeStamp *inTimeStamp,
                               UInt32 inBusNumber, UInt32 inNumberFrames,
                               AudioBufferList *ioData)
 {
-  voice *voices = (voice *)inRefCon;
-  SInt16 *left = (SInt16 *)ioData->mBuffers[0].mData;
-  SInt16 *right = (SInt16 *)ioData->mBuffers[1].mData;
-  for (UInt32 frame = 0; frame < inNumberFrames; frame++)
-  {
-    left[frame] = right[frame] = 0;
-    for (int i = 0; i < 32; i++)
-    {
-      if (voices[i].state == 0) continue;
-      if (voices[i].position >= voices[i].length - 1) voices[i].state = 0;
-
-      left[frame] += (voices[i].data)[voices[i].position] * 1.0f;
-      right[frame] += (voices[i].data)[voices[i].position] * 1.0f;
-      voices[i].position++;
-    }
-  }
-
+  mixerRender(inRefCon, ioData->mBuffers[0].mData, inNumberFrames);
   return 0;
 }
 
@@ -78,17 +57,17 @@ static OSStatus audioCallback(void *inRefCon,
 @property(nonatomic, assign) id<MTLRenderPipelineState> quadShader, postShader;
 @property(nonatomic, assign) MTLRenderPassDescriptor *quadPass, *postPass;
 @property(nonatomic, assign) NSMutableDictionary *geometry;
-@property(nonatomic, assign) double timerCurrent, lag;
+@property(nonatomic, assign) timer loop;
 @property(nonatomic, assign) int mouseMode;
 @property(nonatomic, assign) float clickX, clickY, deltaX, deltaY;
-@property(nonatomic, assign) voice *voices;
+@property(nonatomic, assign) mixer *voices;
 @end
 
 @implementation App
 - (void)applicationDidFinishLaunching:(UIApplication *)application
 {
-  _voices = malloc(sizeof(voice) * 32);
-  memset(_voices, 0, sizeof(voice) * 32);
+  _voices = malloc(sizeof(mixer));
+  mixerInit(_voices);
 
   // Prevent sleeping
   [UIApplication sharedApplication].idleTimerDisabled = YES;
@@ -101,14 +80,13 @@ static OSStatus audioCallback(void *inRefCon,
   AudioStreamBasicDescription audioFormat = {
       .mSampleRate = 44100.00,
       .mFormatID = kAudioFormatLinearPCM,
-      .mFormatFlags = kAudioFormatFlagIsSignedInteger |
-                      kAudioFormatFlagIsPacked |
-                      kAudioFormatFlagIsNonInterleaved,
+      .mFormatFlags =
+          kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked,
       .mBitsPerChannel = 16,
       .mChannelsPerFrame = 2,
       .mFramesPerPacket = 1,
-      .mBytesPerFrame = 2,
-      .mBytesPerPacket = 2};
+      .mBytesPerFrame = 4,
+      .mBytesPerPacket = 4};
 
   // Initialize Audio
   AudioUnit audioUnit;
@@ -143,9 +121,8 @@ static OSStatus audioCallback(void *inRefCon,
   _quadPass = [self createPass:1 with:MTLLoadActionClear];
   [self createBuffers];
 
-  // Initialize timer
-  _timerCurrent = CACurrentMediaTime();
-  _lag = 0.0;
+  // Initialize timer, frames are paced by the run loop
+  timerInit(&_loop, 1E9 / 60, 0, 8);
 
   // Reset Deltas
   _mouseMode = 2;
@@ -182,15 +159,17 @@ static OSStatus audioCallback(void *inRefCon,
   @autoreleasepool
   {
     // Update Timer
-    double timerNext = CACurrentMediaTime();
-    double timerDelta = timerNext - _timerCurrent;
-    _timerCurrent = timerNext;
+    timerUpdate(&_loop);
 
     // Fixed updates
-    for (_lag += timerDelta; _lag >= 1.0 / 60.0; _lag -= 1.0 / 60.0)
+    while (timerStep(&_loop))
     {
     }
 
+    // Interpolation factor between the last two fixed updates
+    float alpha = timerAlpha(&_loop);
+    (void)alpha;
+
     // Reset Deltas
     _clickX = 0.0f;
     _clickY = 0.0f;
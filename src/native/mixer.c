@@ -0,0 +1,260 @@
+#include "mixer.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "atomic.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86_FP)
+#include <emmintrin.h>
+#define MIXER_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+enum
+{
+  COMMAND_PLAY,
+  COMMAND_SET,
+  COMMAND_STOP
+};
+
+static int mixerPush(mixer *m, mixerCommand command)
+{
+  uint32_t head = m->head;
+  if (head - atomicLoad(&m->tail) == MIXER_COMMANDS) return 0;
+  m->commands[head % MIXER_COMMANDS] = command;
+  atomicStore(&m->head, head + 1);
+  return 1;
+}
+
+static void mixerApply(mixerVoice *v, mixerCommand *c)
+{
+  // Constant power panning, pitch as a 32.32 fixed point increment
+  float angle = (c->pan + 1.0f) * 0.78539816f;
+  v->gain = c->gain;
+  v->left = c->gain * cosf(angle);
+  v->right = c->gain * sinf(angle);
+  v->increment = (uint64_t)((double)c->pitch * 4294967296.0);
+}
+
+void mixerInit(mixer *m) { memset(m, 0, sizeof(mixer)); }
+
+int mixerPlay(mixer *m, const int16_t *data, size_t length, float gain,
+              float pan, float pitch, int flags)
+{
+  int voice = m->nextVoice;
+  m->nextVoice = (m->nextVoice + 1) % MIXER_VOICES;
+  mixerCommand command = {COMMAND_PLAY, voice, flags, data, length,
+                          NULL, gain, pan, pitch};
+  return mixerPush(m, command) ? voice : -1;
+}
+
+int mixerStream(mixer *m, stream *s, float gain, float pan)
+{
+  int voice = m->nextVoice;
+  m->nextVoice = (m->nextVoice + 1) % MIXER_VOICES;
+  mixerCommand command = {COMMAND_PLAY, voice, 0, NULL, 0,
+                          s, gain, pan, 1.0f};
+  return mixerPush(m, command) ? voice : -1;
+}
+
+int mixerSet(mixer *m, int voice, float gain, float pan, float pitch)
+{
+  mixerCommand command = {COMMAND_SET, voice, 0, NULL, 0,
+                          NULL, gain, pan, pitch};
+  return mixerPush(m, command);
+}
+
+int mixerStop(mixer *m, int voice)
+{
+  mixerCommand command = {.type = COMMAND_STOP, .voice = voice};
+  return mixerPush(m, command);
+}
+
+static float mixerSample(mixerVoice *v, size_t index)
+{
+  if (index < v->length) return v->data[index];
+  return (v->flags & MIXER_LOOP) ? v->data[index % v->length] : 0.0f;
+}
+
+// Resamples up to `frames` frames of a voice into a mono buffer
+static unsigned int mixerResample(mixerVoice *v, float *out,
+                                  unsigned int frames)
+{
+  unsigned int i = 0;
+  for (; i < frames; i++)
+  {
+    size_t index = v->position >> 32;
+    if (index >= v->length)
+    {
+      if (!(v->flags & MIXER_LOOP)) break;
+      v->position -= (uint64_t)v->length << 32;
+      index -= v->length;
+    }
+
+    float t = (float)(v->position & 0xFFFFFFFF) * (1.0f / 4294967296.0f);
+    float s1 = v->data[index], s2 = mixerSample(v, index + 1);
+    if (v->flags & MIXER_CUBIC)
+    {
+      // Catmull-Rom spline through the four nearest samples
+      float s0 = index ? v->data[index - 1] : s1;
+      float s3 = mixerSample(v, index + 2);
+      out[i] = s1 + 0.5f * t *
+                        (s2 - s0 +
+                         t * (2.0f * s0 - 5.0f * s1 + 4.0f * s2 - s3 +
+                              t * (3.0f * (s1 - s2) + s3 - s0)));
+    }
+    else
+      out[i] = s1 + (s2 - s1) * t;
+    v->position += v->increment;
+  }
+  return i;
+}
+
+// Adds a mono buffer to the interleaved stereo mix with per-side gains
+static void mixerAccumulate(float *mix, const float *mono, unsigned int frames,
+                            float left, float right)
+{
+  unsigned int i = 0;
+#if defined(__AVX2__)
+  __m256 gains = _mm256_setr_ps(left, right, left, right, left, right, left,
+                                right);
+  for (; i + 8 <= frames; i += 8)
+  {
+    __m256 s = _mm256_loadu_ps(mono + i);
+    __m256 lo = _mm256_unpacklo_ps(s, s), hi = _mm256_unpackhi_ps(s, s);
+    __m256 a = _mm256_permute2f128_ps(lo, hi, 0x20);
+    __m256 b = _mm256_permute2f128_ps(lo, hi, 0x31);
+    float *dst = mix + i * 2;
+    _mm256_storeu_ps(dst, _mm256_add_ps(_mm256_loadu_ps(dst),
+                                        _mm256_mul_ps(a, gains)));
+    _mm256_storeu_ps(dst + 8, _mm256_add_ps(_mm256_loadu_ps(dst + 8),
+                                            _mm256_mul_ps(b, gains)));
+  }
+#elif defined(MIXER_SSE2)
+  __m128 gains = _mm_setr_ps(left, right, left, right);
+  for (; i + 4 <= frames; i += 4)
+  {
+    __m128 s = _mm_loadu_ps(mono + i);
+    float *dst = mix + i * 2;
+    _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst),
+                                  _mm_mul_ps(_mm_unpacklo_ps(s, s), gains)));
+    _mm_storeu_ps(dst + 4,
+                  _mm_add_ps(_mm_loadu_ps(dst + 4),
+                             _mm_mul_ps(_mm_unpackhi_ps(s, s), gains)));
+  }
+#elif defined(__ARM_NEON)
+  float32x4_t gains = {left, right, left, right};
+  for (; i + 4 <= frames; i += 4)
+  {
+    float32x4x2_t s = vzipq_f32(vld1q_f32(mono + i), vld1q_f32(mono + i));
+    float *dst = mix + i * 2;
+    vst1q_f32(dst, vmlaq_f32(vld1q_f32(dst), s.val[0], gains));
+    vst1q_f32(dst + 4, vmlaq_f32(vld1q_f32(dst + 4), s.val[1], gains));
+  }
+#endif
+  for (; i < frames; i++)
+  {
+    mix[i * 2] += mono[i] * left;
+    mix[i * 2 + 1] += mono[i] * right;
+  }
+}
+
+// Adds decoded stereo frames to the mix, streams always play at their pitch
+static void mixerAccumulateStereo(float *mix, const int16_t *pcm,
+                                  unsigned int frames, float left, float right)
+{
+  for (unsigned int i = 0; i < frames; i++)
+  {
+    mix[i * 2] += pcm[i * 2] * left;
+    mix[i * 2 + 1] += pcm[i * 2 + 1] * right;
+  }
+}
+
+// Converts the mix to signed 16-bit with saturation
+static void mixerConvert(int16_t *out, const float *mix, unsigned int count)
+{
+  unsigned int i = 0;
+#if defined(__AVX2__)
+  for (; i + 16 <= count; i += 16)
+  {
+    __m256i a = _mm256_cvtps_epi32(_mm256_loadu_ps(mix + i));
+    __m256i b = _mm256_cvtps_epi32(_mm256_loadu_ps(mix + i + 8));
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+    _mm256_storeu_si256((__m256i *)(out + i), packed);
+  }
+#elif defined(MIXER_SSE2)
+  for (; i + 8 <= count; i += 8)
+  {
+    __m128i a = _mm_cvtps_epi32(_mm_loadu_ps(mix + i));
+    __m128i b = _mm_cvtps_epi32(_mm_loadu_ps(mix + i + 4));
+    _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(a, b));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for (; i + 8 <= count; i += 8)
+  {
+    int32x4_t a = vcvtnq_s32_f32(vld1q_f32(mix + i));
+    int32x4_t b = vcvtnq_s32_f32(vld1q_f32(mix + i + 4));
+    vst1q_s16(out + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+  }
+#endif
+  for (; i < count; i++)
+  {
+    float s = mix[i];
+    out[i] = s > 32767.0f ? 32767 : s < -32768.0f ? -32768 : lrintf(s);
+  }
+}
+
+void mixerRender(mixer *m, int16_t *out, unsigned int frames)
+{
+  // Apply pending commands from the game thread
+  uint32_t tail = m->tail, head = atomicLoad(&m->head);
+  for (; tail != head; tail++)
+  {
+    mixerCommand *c = &m->commands[tail % MIXER_COMMANDS];
+    mixerVoice *v = &m->voices[c->voice];
+    if (c->type == COMMAND_PLAY)
+    {
+      v->data = c->data;
+      v->length = c->length;
+      v->stream = c->stream;
+      v->position = 0;
+      v->flags = c->flags;
+      v->active = (c->data && c->length) || c->stream;
+    }
+    if (c->type == COMMAND_STOP) v->active = 0;
+    if (c->type != COMMAND_STOP) mixerApply(v, c);
+  }
+  atomicStore(&m->tail, tail);
+
+  // Mix in blocks that fit the scratch buffers
+  while (frames > 0)
+  {
+    unsigned int block = frames < MIXER_FRAMES ? frames : MIXER_FRAMES;
+    memset(m->mix, 0, block * 2 * sizeof(float));
+    for (int i = 0; i < MIXER_VOICES; i++)
+    {
+      mixerVoice *v = &m->voices[i];
+      if (!v->active) continue;
+
+      // Streams never block, they play silence until more is decoded
+      if (v->stream)
+      {
+        unsigned int count = streamRead(v->stream, m->pcm, block);
+        mixerAccumulateStereo(m->mix, m->pcm, count, v->left, v->right);
+        if (count < block && streamFinished(v->stream)) v->active = 0;
+        continue;
+      }
+
+      unsigned int count = mixerResample(v, m->mono, block);
+      mixerAccumulate(m->mix, m->mono, count, v->left, v->right);
+      if (count < block) v->active = 0;
+    }
+    mixerConvert(out, m->mix, block * 2);
+    out += block * 2;
+    frames -= block;
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stream.h"
+
+#define MIXER_VOICES 32
+#define MIXER_COMMANDS 256
+#define MIXER_FRAMES 256
+
+// Voice flags
+#define MIXER_LOOP 1
+#define MIXER_CUBIC 2
+
+typedef struct
+{
+  const int16_t *data;
+  size_t length;
+  stream *stream;
+  uint64_t position, increment;
+  float gain, left, right;
+  int flags, active;
+} mixerVoice;
+
+typedef struct
+{
+  int type, voice, flags;
+  const int16_t *data;
+  size_t length;
+  stream *stream;
+  float gain, pan, pitch;
+} mixerCommand;
+
+// Voices are owned by the audio thread and only changed through commands
+// pushed from a single game thread, so rendering never locks or allocates
+typedef struct
+{
+  mixerVoice voices[MIXER_VOICES];
+  mixerCommand commands[MIXER_COMMANDS];
+  volatile uint32_t head, tail;
+  int nextVoice;
+  float mono[MIXER_FRAMES];
+  int16_t pcm[MIXER_FRAMES * 2];
+  float mix[MIXER_FRAMES * 2];
+} mixer;
+
+void mixerInit(mixer *m);
+int mixerPlay(mixer *m, const int16_t *data, size_t length, float gain,
+              float pan, float pitch, int flags);
+int mixerStream(mixer *m, stream *s, float gain, float pan);
+int mixerSet(mixer *m, int voice, float gain, float pan, float pitch);
+int mixerStop(mixer *m, int voice);
+void mixerRender(mixer *m, int16_t *out, unsigned int frames);
@@ -0,0 +1,254 @@
+#include "stream.h"
+
+#include <string.h>
+
+#include "atomic.h"
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+static const streamCodec *streamCodecs[] = {&streamWav};
+
+static void *streamThread(void *data)
+{
+  stream *s = data;
+  while (atomicLoad(&s->running))
+  {
+    // Sleep until the mixer frees a block
+    uint32_t head = s->head;
+    if (head - atomicLoad(&s->tail) == STREAM_BLOCKS ||
+        atomicLoad(&s->finished))
+    {
+      semaphoreWait(&s->wake);
+      continue;
+    }
+
+    unsigned int index = head % STREAM_BLOCKS, frames = 0;
+    while (frames < STREAM_FRAMES)
+    {
+      int16_t *out = s->blocks[index] + frames * 2;
+      unsigned int count = s->codec->decode(s, out, STREAM_FRAMES - frames);
+      frames += count;
+      if (count > 0) continue;
+      if (!s->loop) break;
+      s->codec->rewind(s);
+    }
+    s->frames[index] = frames;
+    if (frames > 0) atomicStore(&s->head, head + 1);
+    if (frames < STREAM_FRAMES) atomicStore(&s->finished, 1);
+  }
+  return NULL;
+}
+
+int streamOpen(stream *s, const char *path, int loop)
+{
+  memset(s, 0, sizeof(stream));
+  if (fileMap(&s->file, path)) return -1;
+#if !defined(_WIN32)
+  madvise((void *)s->file.data, s->file.size, MADV_SEQUENTIAL);
+#endif
+
+  // Find a codec that understands the file
+  s->codec = NULL;
+  for (size_t i = 0; i < sizeof(streamCodecs) / sizeof(*streamCodecs); i++)
+  {
+    if (streamCodecs[i]->open(s) == 0)
+    {
+      s->codec = streamCodecs[i];
+      break;
+    }
+  }
+  if (!s->codec)
+  {
+    fileUnmap(&s->file);
+    return -1;
+  }
+
+  // Start decoding ahead
+  s->loop = loop;
+  s->running = 1;
+  semaphoreInit(&s->wake);
+  if (threadCreate(&s->worker, streamThread, s))
+  {
+    semaphoreDestroy(&s->wake);
+    fileUnmap(&s->file);
+    return -1;
+  }
+  return 0;
+}
+
+void streamClose(stream *s)
+{
+  if (!s->running) return;
+  atomicStore(&s->running, 0);
+  semaphorePost(&s->wake);
+  threadJoin(s->worker);
+  semaphoreDestroy(&s->wake);
+  fileUnmap(&s->file);
+}
+
+unsigned int streamRead(stream *s, int16_t *out, unsigned int frames)
+{
+  unsigned int read = 0;
+  uint32_t tail = s->tail, head = atomicLoad(&s->head);
+  while (read < frames && tail != head)
+  {
+    unsigned int index = tail % STREAM_BLOCKS;
+    unsigned int count = s->frames[index] - s->offset;
+    if (count > frames - read) count = frames - read;
+    memcpy(out + read * 2, s->blocks[index] + s->offset * 2,
+           count * 2 * sizeof(int16_t));
+    read += count;
+    s->offset += count;
+
+    // Hand the block back to the decoder
+    if (s->offset == s->frames[index])
+    {
+      s->offset = 0;
+      atomicStore(&s->tail, ++tail);
+      semaphorePost(&s->wake);
+    }
+  }
+  return read;
+}
+
+int streamFinished(stream *s)
+{
+  return atomicLoad(&s->finished) && atomicLoad(&s->head) == s->tail;
+}
+
+// WAV container with 16-bit PCM or IMA-ADPCM data
+
+static const int adpcmIndex[16] = {-1, -1, -1, -1, 2, 4, 6, 8,
+                                   -1, -1, -1, -1, 2, 4, 6, 8};
+
+static const int adpcmStep[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+static uint32_t wavRead32(const uint8_t *p)
+{
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static int wavOpen(stream *s)
+{
+  const uint8_t *p = s->file.data, *end = p + s->file.size;
+  if (s->file.size < 12 || memcmp(p, "RIFF", 4) || memcmp(p + 8, "WAVE", 4))
+    return -1;
+
+  // Walk the chunks looking for the format and the data
+  for (p += 12; p + 8 <= end;)
+  {
+    uint32_t size = wavRead32(p + 4);
+    const uint8_t *chunk = p + 8;
+    if (size > (size_t)(end - chunk)) size = end - chunk;
+    if (!memcmp(p, "fmt ", 4) && size >= 16)
+    {
+      s->format = chunk[0] | chunk[1] << 8;
+      s->channels = chunk[2] | chunk[3] << 8;
+      s->rate = wavRead32(chunk + 4);
+      s->blockAlign = chunk[12] | chunk[13] << 8;
+    }
+    else if (!memcmp(p, "data", 4))
+    {
+      s->data = chunk;
+      s->size = size;
+    }
+    p = chunk + size + (size & 1);
+  }
+  if (!s->data || s->channels < 1 || s->channels > 2) return -1;
+
+  // 16-bit PCM or IMA-ADPCM, in blocks that fit the scratch buffer
+  if (s->format == 0x11 && s->blockAlign > 4 * s->channels)
+    s->blockFrames = (s->blockAlign - 4 * s->channels) * 2 / s->channels + 1;
+  else if (s->format != 1 || s->blockAlign != 2 * s->channels)
+    return -1;
+  return s->blockFrames > STREAM_SCRATCH ? -1 : 0;
+}
+
+static void wavDecodeAdpcm(stream *s, const uint8_t *block)
+{
+  for (unsigned int c = 0; c < s->channels; c++)
+  {
+    const uint8_t *header = block + c * 4;
+    int predictor = (int16_t)(header[0] | header[1] << 8);
+    int index = header[2] > 88 ? 88 : header[2];
+    int16_t *out = s->scratch + c;
+    out[0] = predictor;
+
+    // Nibbles come in groups of 8 samples interleaved per channel
+    for (unsigned int i = 1; i < s->blockFrames; i++)
+    {
+      unsigned int n = i - 1, group = n / 8;
+      const uint8_t *byte = block + 4 * s->channels +
+                            (group * s->channels + c) * 4 + (n % 8) / 2;
+      int nibble = (n & 1) ? *byte >> 4 : *byte & 15;
+      int step = adpcmStep[index], diff = step >> 3;
+      if (nibble & 1) diff += step >> 2;
+      if (nibble & 2) diff += step >> 1;
+      if (nibble & 4) diff += step;
+      predictor += (nibble & 8) ? -diff : diff;
+      predictor = predictor < -32768 ? -32768
+                                     : predictor > 32767 ? 32767 : predictor;
+      index += adpcmIndex[nibble];
+      index = index < 0 ? 0 : index > 88 ? 88 : index;
+      out[i * s->channels] = predictor;
+    }
+  }
+}
+
+static unsigned int wavDecode(stream *s, int16_t *out, unsigned int frames)
+{
+  unsigned int done = 0;
+  while (done < frames)
+  {
+    // Refill the scratch buffer with the next block
+    if (s->scratchCursor == s->scratchFrames)
+    {
+      size_t left = s->size - s->cursor;
+      if (s->format == 0x11)
+      {
+        if (left < s->blockAlign) break;
+        wavDecodeAdpcm(s, s->data + s->cursor);
+        s->scratchFrames = s->blockFrames;
+        s->cursor += s->blockAlign;
+      }
+      else
+      {
+        s->scratchFrames = left / s->blockAlign;
+        if (s->scratchFrames > STREAM_SCRATCH) s->scratchFrames = STREAM_SCRATCH;
+        if (s->scratchFrames == 0) break;
+        memcpy(s->scratch, s->data + s->cursor,
+               s->scratchFrames * s->blockAlign);
+        s->cursor += s->scratchFrames * s->blockAlign;
+      }
+      s->scratchCursor = 0;
+    }
+
+    // Copy out as stereo
+    for (; done < frames && s->scratchCursor < s->scratchFrames; done++)
+    {
+      int16_t *frame = s->scratch + s->scratchCursor++ * s->channels;
+      out[done * 2] = frame[0];
+      out[done * 2 + 1] = frame[s->channels - 1];
+    }
+  }
+  return done;
+}
+
+static void wavRewind(stream *s)
+{
+  s->cursor = 0;
+  s->scratchFrames = s->scratchCursor = 0;
+}
+
+const streamCodec streamWav = {wavOpen, wavDecode, wavRewind};
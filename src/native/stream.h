@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "file.h"
+#include "thread.h"
+
+#define STREAM_BLOCKS 4
+#define STREAM_FRAMES 4096
+#define STREAM_SCRATCH 8192
+
+typedef struct stream stream;
+
+// Decodes a memory-mapped file into interleaved stereo S16 frames
+typedef struct
+{
+  int (*open)(stream *s);
+  unsigned int (*decode)(stream *s, int16_t *out, unsigned int frames);
+  void (*rewind)(stream *s);
+} streamCodec;
+
+extern const streamCodec streamWav;
+
+// A bounded ring of decoded blocks, filled ahead of playback by a worker
+// thread and drained by the mixer, so memory use doesn't grow with length
+struct stream
+{
+  mapping file;
+  const streamCodec *codec;
+  unsigned int rate, channels, format, blockAlign, blockFrames;
+  const uint8_t *data;
+  size_t size, cursor;
+  int16_t scratch[STREAM_SCRATCH * 2];
+  unsigned int scratchFrames, scratchCursor;
+
+  int16_t blocks[STREAM_BLOCKS][STREAM_FRAMES * 2];
+  unsigned int frames[STREAM_BLOCKS], offset;
+  volatile uint32_t head, tail, finished, running;
+  int loop;
+  thread worker;
+  semaphore wake;
+};
+
+int streamOpen(stream *s, const char *path, int loop);
+void streamClose(stream *s);
+unsigned int streamRead(stream *s, int16_t *out, unsigned int frames);
+int streamFinished(stream *s);
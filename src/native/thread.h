@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdlib.h>
+
+// Thin wrappers over the native threads and counting semaphores
+#if defined(_WIN32)
+#include <windows.h>
+
+typedef HANDLE thread;
+typedef HANDLE semaphore;
+
+typedef struct
+{
+  void *(*start)(void *);
+  void *data;
+} threadStart;
+
+static DWORD WINAPI threadTrampoline(LPVOID data)
+{
+  threadStart start = *(threadStart *)data;
+  free(data);
+  start.start(start.data);
+  return 0;
+}
+
+static inline int threadCreate(thread *t, void *(*start)(void *), void *data)
+{
+  threadStart *trampoline = malloc(sizeof(threadStart));
+  trampoline->start = start;
+  trampoline->data = data;
+  *t = CreateThread(NULL, 0, threadTrampoline, trampoline, 0, NULL);
+  if (!*t) free(trampoline);
+  return *t ? 0 : -1;
+}
+
+static inline void threadJoin(thread t)
+{
+  WaitForSingleObject(t, INFINITE);
+  CloseHandle(t);
+}
+
+static inline void semaphoreInit(semaphore *s)
+{
+  *s = CreateSemaphoreW(NULL, 0, LONG_MAX, NULL);
+}
+
+static inline void semaphoreWait(semaphore *s)
+{
+  WaitForSingleObject(*s, INFINITE);
+}
+
+static inline void semaphorePost(semaphore *s) { ReleaseSemaphore(*s, 1, NULL); }
+static inline void semaphoreDestroy(semaphore *s) { CloseHandle(*s); }
+#else
+#include <pthread.h>
+
+typedef pthread_t thread;
+
+static inline int threadCreate(thread *t, void *(*start)(void *), void *data)
+{
+  return pthread_create(t, NULL, start, data);
+}
+
+static inline void threadJoin(thread t) { pthread_join(t, NULL); }
+
+#if defined(__APPLE__)
+#include <dispatch/dispatch.h>
+
+typedef dispatch_semaphore_t semaphore;
+
+static inline void semaphoreInit(semaphore *s)
+{
+  *s = dispatch_semaphore_create(0);
+}
+
+static inline void semaphoreWait(semaphore *s)
+{
+  dispatch_semaphore_wait(*s, DISPATCH_TIME_FOREVER);
+}
+
+static inline void semaphorePost(semaphore *s) { dispatch_semaphore_signal(*s); }
+static inline void semaphoreDestroy(semaphore *s) { dispatch_release(*s); }
+#else
+#include <semaphore.h>
+
+typedef sem_t semaphore;
+
+static inline void semaphoreInit(semaphore *s) { sem_init(s, 0, 0); }
+
+static inline void semaphoreWait(semaphore *s)
+{
+  while (sem_wait(s) != 0)
+  {
+  }
+}
+
+static inline void semaphorePost(semaphore *s) { sem_post(s); }
+static inline void semaphoreDestroy(semaphore *s) { sem_destroy(s); }
+#endif
+#endif
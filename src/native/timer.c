@@ -0,0 +1,113 @@
+#include "timer.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#elif defined(__APPLE__)
+#include <mach/mach_time.h>
+#else
+#include <errno.h>
+#include <time.h>
+#endif
+
+// Time left to the deadline that is spent spinning instead of sleeping
+#define TIMER_SPIN 200000
+
+uint64_t timerNow()
+{
+#if defined(_WIN32)
+  static LARGE_INTEGER frequency;
+  if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000 +
+         (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000 /
+             frequency.QuadPart;
+#elif defined(__APPLE__)
+  static mach_timebase_info_data_t timebase;
+  if (timebase.denom == 0) mach_timebase_info(&timebase);
+  return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+#endif
+}
+
+void timerInit(timer *t, uint64_t step, uint64_t interval,
+               unsigned int maxSteps)
+{
+  t->current = t->deadline = timerNow();
+  t->lag = 0;
+  t->step = step;
+  t->interval = interval;
+  t->maxSteps = maxSteps;
+}
+
+uint64_t timerUpdate(timer *t)
+{
+  uint64_t now = timerNow();
+  uint64_t delta = now - t->current;
+  t->current = now;
+
+  // Drop the time we can't catch up with instead of spiralling
+  t->lag += delta;
+  if (t->lag > t->step * t->maxSteps) t->lag = t->step * t->maxSteps;
+
+  // Schedule the next frame, re-synchronizing after a missed deadline
+  t->deadline += t->interval;
+  if (t->deadline < now) t->deadline = now;
+  return delta;
+}
+
+int timerStep(timer *t)
+{
+  if (t->lag < t->step) return 0;
+  t->lag -= t->step;
+  return 1;
+}
+
+float timerAlpha(timer *t) { return (float)t->lag / (float)t->step; }
+
+void timerWait(timer *t)
+{
+  uint64_t now = timerNow();
+  if (t->interval == 0 || now >= t->deadline) return;
+
+  // Sleep until shortly before the deadline
+  if (t->deadline - now > TIMER_SPIN)
+  {
+#if defined(_WIN32)
+    static HANDLE waitable = NULL;
+    if (!waitable)
+      waitable = CreateWaitableTimerExW(
+          NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!waitable) waitable = CreateWaitableTimerW(NULL, FALSE, NULL);
+    LARGE_INTEGER due = {.QuadPart = -(LONGLONG)((t->deadline - now -
+                                                   TIMER_SPIN) / 100)};
+    SetWaitableTimer(waitable, &due, 0, NULL, NULL, FALSE);
+    WaitForSingleObject(waitable, INFINITE);
+#elif defined(__APPLE__)
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    uint64_t wait = (t->deadline - now - TIMER_SPIN) * timebase.denom /
+                    timebase.numer;
+    mach_wait_until(mach_absolute_time() + wait);
+#else
+    uint64_t wake = t->deadline - TIMER_SPIN;
+    struct timespec time = {.tv_sec = wake / 1000000000,
+                            .tv_nsec = wake % 1000000000};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, NULL) ==
+           EINTR)
+    {
+    }
+#endif
+  }
+
+  // Spin for the remainder
+  while (timerNow() < t->deadline)
+  {
+  }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+// Fixed-step scheduler. All times are in nanoseconds.
+typedef struct
+{
+  uint64_t current, deadline, lag;
+  uint64_t step, interval;
+  unsigned int maxSteps;
+} timer;
+
+uint64_t timerNow();
+void timerInit(timer *t, uint64_t step, uint64_t interval,
+               unsigned int maxSteps);
+uint64_t timerUpdate(timer *t);
+int timerStep(timer *t);
+float timerAlpha(timer *t);
+void timerWait(timer *t);
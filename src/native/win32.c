@@ -3,6 +3,9 @@
 #include <windows.h>
 #include <xinput.h>
 
+#include "mixer.h"
+#include "timer.h"
+
 #pragma comment(lib, "user32")
 #pragma comment(lib, "d3d11")
 #pragma comment(lib, "dxguid")
@@ -107,14 +110,20 @@ int main(int argc, char const *argv[])
   };
   primaryBuffer->lpVtbl->SetFormat(primaryBuffer, &format);
 
-  // Create Secondary Audio Buffer
+  // Create Secondary Audio Buffer, mixed ahead of the write cursor
+  DWORD audioBytes = 4096 * 4, audioLatency = 2048 * 4;
   DSBUFFERDESC bufferDesc2 = {
       .dwSize = sizeof(DSBUFFERDESC),
-      .dwBufferBytes = 1024,
+      .dwFlags = DSBCAPS_GETCURRENTPOSITION2 | DSBCAPS_GLOBALFOCUS,
+      .dwBufferBytes = audioBytes,
       .lpwfxFormat = &format,
   };
   LPDIRECTSOUNDBUFFER secondary_buffer;
   dsound->lpVtbl->CreateSoundBuffer(dsound, &bufferDesc2, &secondary_buffer, 0);
+  secondary_buffer->lpVtbl->Play(secondary_buffer, 0, 0, DSBPLAY_LOOPING);
+  DWORD audioCursor = 0;
+  static mixer voices;
+  mixerInit(&voices);
 
   // Create Direct3D Device and Swap-Chain
   DXGI_SWAP_CHAIN_DESC desc = {
@@ -181,11 +190,8 @@ int main(int argc, char const *argv[])
                                       &buffer);
 
   // Start the Timer
-  long long timerResolution;
-  long long timerCurrent;
-  QueryPerformanceFrequency((LARGE_INTEGER *)&timerResolution);
-  QueryPerformanceCounter((LARGE_INTEGER *)&timerCurrent);
-  double lag = 0;
+  timer loop;
+  timerInit(&loop, 1E9 / 60, 1E9 / 60, 8);
 
   // Reset Deltas
   mouseX = 0.0f;
@@ -196,6 +202,9 @@ int main(int argc, char const *argv[])
   MSG msg = {0};
   while (msg.message != WM_QUIT)
   {
+    // Wait for the next frame
+    timerWait(&loop);
+
     while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE))
     {
       TranslateMessage(&msg);
@@ -213,22 +222,45 @@ int main(int argc, char const *argv[])
     }
 
     // Update Timer
-    long long timerNext;
-    QueryPerformanceCounter((LARGE_INTEGER *)&timerNext);
-    double timerDelta = (timerNext - timerCurrent) * 10E8 / timerResolution;
-    timerCurrent = timerNext;
+    timerUpdate(&loop);
 
     // Fixed updates
-    for (lag += timerDelta; lag >= 1.0 / 60.0; lag -= 1.0 / 60.0)
+    while (timerStep(&loop))
     {
     }
 
+    // Interpolation factor between the last two fixed updates
+    float alpha = timerAlpha(&loop);
+    (void)alpha;
+
     // Reset Deltas
     deltaX = 0.0f;
     deltaY = 0.0f;
     clickX = 0.0f;
     clickY = 0.0f;
 
+    // Fill the Audio Buffer up to a fixed distance past the write cursor
+    DWORD playCursor, writeCursor;
+    secondary_buffer->lpVtbl->GetCurrentPosition(secondary_buffer, &playCursor,
+                                                 &writeCursor);
+    DWORD pending = (audioCursor - playCursor + audioBytes) % audioBytes;
+    DWORD safe = (writeCursor - playCursor + audioBytes) % audioBytes;
+    if (pending < safe) audioCursor = writeCursor, pending = safe;
+    DWORD bytes =
+        pending < safe + audioLatency ? safe + audioLatency - pending : 0;
+    void *region1, *region2;
+    DWORD size1, size2;
+    if (bytes && SUCCEEDED(secondary_buffer->lpVtbl->Lock(
+                     secondary_buffer, audioCursor, bytes, &region1, &size1,
+                     &region2, &size2, 0)))
+    {
+      mixerRender(&voices, region1, size1 / 4);
+      if (region2) mixerRender(&voices, region2, size2 / 4);
+      secondary_buffer->lpVtbl->Unlock(secondary_buffer, region1, size1,
+                                       region2, size2);
+      audioCursor = (audioCursor + bytes) % audioBytes;
+    }
+
     // Set Viewport and Blank Colors
     RECT rect;
     GetWindowRect(window, &rect);
@@ -248,6 +280,9 @@ int main(int argc, char const *argv[])
     swapchain->lpVtbl->Present(swapchain, 0, 0);
   }
 
+  secondary_buffer->lpVtbl->Release(secondary_buffer);
+  primaryBuffer->lpVtbl->Release(primaryBuffer);
+  dsound->lpVtbl->Release(dsound);
   swapchain->lpVtbl->Release(swapchain);
   gBuffer->lpVtbl->Release(gBuffer);
   gBufferTex->lpVtbl->Release(gBufferTex);
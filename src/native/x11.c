@@ -1,6 +1,10 @@
 #include <GL/glx.h>
 #include <X11/Xlib.h>
-#include <alsa/asoundlib.h>
+#include <poll.h>
+
+#include "alsa.h"
+#include "mixer.h"
+#include "timer.h"
 
 void (*glGenFramebuffers)(GLsizei n, GLuint *framebuffers);
 void (*glDeleteFramebuffers)(GLsizei n, GLuint *framebuffers);
@@ -24,6 +28,11 @@ int createTexture(unsigned int w, unsigned int h, unsigned int type)
   return texture;
 }
 
+void renderAudio(void *user, int16_t *out, unsigned int frames)
+{
+  mixerRender(user, out, frames);
+}
+
 int main()
 {
   Display *display = XOpenDisplay(NULL);
@@ -37,8 +46,8 @@ int main()
   int screen = DefaultScreen(display);
   Window root = RootWindow(display, screen);
   Window window = XCreateSimpleWindow(display, root, 10, 10, 640, 480, 1, 0, 0);
-  int eventMask =
-      ExposureMask | KeyPressMask | ButtonPressMask | ButtonReleaseMask;
+  int eventMask = ExposureMask | KeyPressMask | ButtonPressMask |
+                  ButtonReleaseMask | PointerMotionMask;
   XSelectInput(display, window, eventMask);
   XMapWindow(display, window);
   Atom deleteWindow = XInternAtom(display, "WM_DELETE_WINDOW", True);
@@ -49,36 +58,14 @@ int main()
   Atom fullscreenAtom = XInternAtom(display, "_NET_WM_STATE_FULLSCREEN", False);
   int fullscreen = 0;
 
-  // Initialize ALSA
-  snd_pcm_t *pcm_handle;
-  snd_pcm_open(&pcm_handle, "hw:0,0", SND_PCM_STREAM_PLAYBACK,
-               SND_PCM_NONBLOCK);
-  long unsigned int period_size = 1024;
-  unsigned int freq = 44100;
-  unsigned int periods = 2;
-
-  // Set ALSA Hardware Parameters
-  int dir = 0;
-  snd_pcm_hw_params_t *hw_params = NULL;
-  snd_pcm_hw_params_any(pcm_handle, hw_params);
-  snd_pcm_hw_params_set_access(pcm_handle, hw_params,
-                               SND_PCM_ACCESS_RW_INTERLEAVED);
-  snd_pcm_hw_params_set_format(pcm_handle, hw_params, SND_PCM_FORMAT_S16_LE);
-  snd_pcm_hw_params_set_rate_near(pcm_handle, hw_params, &freq, &dir);
-  snd_pcm_hw_params_set_channels(pcm_handle, hw_params, 2);
-  snd_pcm_hw_params_set_period_size_near(pcm_handle, hw_params, &period_size,
-                                         &dir);
-  snd_pcm_hw_params_set_periods_min(pcm_handle, hw_params, &periods, &dir);
-  snd_pcm_hw_params_set_periods_first(pcm_handle, hw_params, &periods, &dir);
-  snd_pcm_hw_params(pcm_handle, hw_params);
-
-  // Set ALSA Software Parameters
-  snd_pcm_sw_params_t *sw_params = NULL;
-  snd_pcm_sw_params_alloca(&sw_params);
-  snd_pcm_sw_params_current(pcm_handle, sw_params);
-  snd_pcm_sw_params_set_avail_min(pcm_handle, sw_params, period_size);
-  snd_pcm_sw_params_set_start_threshold(pcm_handle, sw_params, 1);
-  snd_pcm_sw_params(pcm_handle, sw_params);
+  // Initialize ALSA, VIGIER_AUDIO_DEVICE=null runs without a sound card
+  static mixer voices;
+  mixerInit(&voices);
+  audio output;
+  const char *device = getenv("VIGIER_AUDIO_DEVICE");
+  if (audioOpen(&output, device ? device : "default", 44100, 256, 3,
+                renderAudio, &voices) < 0)
+    printf("Cannot open audio device\n");
 
   // Initialize OpenGL Extensions
   glGenFramebuffers = (void (*)())glXGetProcAddressARB(
@@ -117,80 +104,99 @@ int main()
   glDrawBuffers(2, (GLenum[]){GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT});
 
   // Start the Timer
-  struct timespec time;
-  clock_gettime(CLOCK_MONOTONIC, &time);
-  uint64_t timerCurrent = (time.tv_sec * 10E8 + time.tv_nsec);
-  uint64_t lag = 0.0;
+  timer loop;
+  timerInit(&loop, 1E9 / 60, 1E9 / 60, 8);
   uint64_t xscreenLag = 0.0;
 
   unsigned int mouseMode = 0;
   int mouseX = 0, mouseY = 0, clickX = 0, clickY = 0, deltaX = 0, deltaY = 0;
 
-  while (1)
+  int running = 1;
+  while (running)
   {
-    XEvent e;
-    XNextEvent(display, &e);
-    if (e.type == ClientMessage &&
-        e.xclient.data.l[0] == (long int)deleteWindow)
-      break;
-
-    // Mouse Cursor
-    if (e.type == MotionNotify && e.xbutton.button == mouseMode - 1)
-    {
-      XGrabPointer(display, window, True,
-                   ButtonPressMask | ButtonReleaseMask | PointerMotionMask,
-                   GrabModeAsync, GrabModeAsync, window, None, CurrentTime);
-      XDefineCursor(display, window, None);
-      mouseX += (deltaX = e.xmotion.x - mouseX);
-      mouseX += (deltaY = e.xmotion.y - mouseY);
-    }
-    else if (e.type == ButtonPress && e.xbutton.button == 1)
+    // Wait on the X connection until the next frame is due, reading incoming
+    // events into the queue so that poll() only wakes up on new data
+    for (uint64_t now = timerNow(); now + 1E6 < loop.deadline; now = timerNow())
     {
-      mouseX = e.xmotion.x;
-      mouseY = e.xmotion.y;
-    }
-    else if (e.type == ButtonRelease && e.xbutton.button == 1 &&
-             deltaY + deltaY == 0.0f)
-    {
-      if (mouseMode != 1) XUngrabPointer(display, CurrentTime);
-      clickX = e.xmotion.x;
-      clickY = e.xmotion.y;
-    }
-    else if (e.type == KeyPress && e.xkey.keycode == 13 &&
-             e.xkey.state & Mod1Mask)
-    {
-      fullscreen = !fullscreen;
-      XSendEvent(display, root, False,
-                 SubstructureNotifyMask | SubstructureRedirectMask,
-                 &(XEvent){.xclient.window = window,
-                           .xclient.format = 32,
-                           .xclient.message_type = stateAtom,
-                           .xclient.data.l[0] = fullscreen,
-                           .xclient.data.l[1] = fullscreenAtom,
-                           .xclient.data.l[3] = 1});
+      XPending(display);
+      struct pollfd fd = {.fd = ConnectionNumber(display), .events = POLLIN};
+      poll(&fd, 1, (loop.deadline - now) / 1000000);
     }
+    timerWait(&loop);
 
-    // Toggle Fullscreen
-    else if (e.type == KeyPress && e.xkey.keycode == 13 &&
-             e.xkey.state & Mod1Mask)
+    // Drain all pending events
+    while (running && XPending(display))
     {
-      fullscreen = !fullscreen;
-      XEvent event = {0};
-      event.xclient.window = window;
-      event.xclient.format = 32;
-      event.xclient.message_type = stateAtom;
-      event.xclient.data.l[0] = fullscreen;
-      event.xclient.data.l[1] = fullscreenAtom;
-      event.xclient.data.l[3] = 1;
-      XSendEvent(display, root, False,
-                 SubstructureNotifyMask | SubstructureRedirectMask, &event);
+      XEvent e;
+      XNextEvent(display, &e);
+      if (e.type == ClientMessage &&
+          e.xclient.data.l[0] == (long int)deleteWindow)
+        running = 0;
+
+      // Coalesce consecutive motion events into a single delta
+      while (e.type == MotionNotify && XPending(display))
+      {
+        XEvent next;
+        XPeekEvent(display, &next);
+        if (next.type != MotionNotify) break;
+        XNextEvent(display, &e);
+      }
+
+      // Mouse Cursor
+      if (e.type == MotionNotify && e.xbutton.button == mouseMode - 1)
+      {
+        XGrabPointer(display, window, True,
+                     ButtonPressMask | ButtonReleaseMask | PointerMotionMask,
+                     GrabModeAsync, GrabModeAsync, window, None, CurrentTime);
+        XDefineCursor(display, window, None);
+        mouseX += (deltaX = e.xmotion.x - mouseX);
+        mouseX += (deltaY = e.xmotion.y - mouseY);
+      }
+      else if (e.type == ButtonPress && e.xbutton.button == 1)
+      {
+        mouseX = e.xmotion.x;
+        mouseY = e.xmotion.y;
+      }
+      else if (e.type == ButtonRelease && e.xbutton.button == 1 &&
+               deltaY + deltaY == 0.0f)
+      {
+        if (mouseMode != 1) XUngrabPointer(display, CurrentTime);
+        clickX = e.xmotion.x;
+        clickY = e.xmotion.y;
+      }
+      else if (e.type == KeyPress && e.xkey.keycode == 13 &&
+               e.xkey.state & Mod1Mask)
+      {
+        fullscreen = !fullscreen;
+        XSendEvent(display, root, False,
+                   SubstructureNotifyMask | SubstructureRedirectMask,
+                   &(XEvent){.xclient.window = window,
+                             .xclient.format = 32,
+                             .xclient.message_type = stateAtom,
+                             .xclient.data.l[0] = fullscreen,
+                             .xclient.data.l[1] = fullscreenAtom,
+                             .xclient.data.l[3] = 1});
+      }
+
+      // Toggle Fullscreen
+      else if (e.type == KeyPress && e.xkey.keycode == 13 &&
+               e.xkey.state & Mod1Mask)
+      {
+        fullscreen = !fullscreen;
+        XEvent event = {0};
+        event.xclient.window = window;
+        event.xclient.format = 32;
+        event.xclient.message_type = stateAtom;
+        event.xclient.data.l[0] = fullscreen;
+        event.xclient.data.l[1] = fullscreenAtom;
+        event.xclient.data.l[3] = 1;
+        XSendEvent(display, root, False,
+                   SubstructureNotifyMask | SubstructureRedirectMask, &event);
+      }
     }
 
     // Update Timer
-    clock_gettime(CLOCK_MONOTONIC, &time);
-    uint64_t timerNext = (time.tv_sec * 10E8 + time.tv_nsec);
-    uint64_t timerDelta = timerNext - timerCurrent;
-    timerCurrent = timerNext;
+    uint64_t timerDelta = timerUpdate(&loop);
 
     // Periodically reset the screensaver
     xscreenLag += timerDelta;
@@ -201,15 +207,19 @@ int main()
     }
 
     // Fixed updates
-    for (lag += timerDelta; lag >= 1.0 / 60.0; lag -= 1.0 / 60.0)
+    while (timerStep(&loop))
     {
     }
 
+    // Interpolation factor between the last two fixed updates
+    float alpha = timerAlpha(&loop);
+
     // Reset mouse vars
     clickX = 0, clickY = 0, deltaX = 0, deltaY = 0;
 
     (void)clickX;
     (void)clickY;
+    (void)alpha;
 
     // Render to G-Buffer
     glBindFramebuffer(GL_FRAMEBUFFER, gbuffer);
@@ -219,6 +229,7 @@ int main()
     glXSwapBuffers(display, window);
   }
 
+  audioClose(&output);
   glDeleteTextures(1, &backbuffer);
   glDeleteTextures(1, &depthbuffer);
   glDeleteFramebuffers(1, &gbuffer);